@@ -5,4 +5,6 @@ SUBDIRS += \
     httpwriter \
     httpclient \
     restfulhttpnode \
-    httpmultipartreader
+    httpmultipartreader \
+    httpringtransport \
+    benchmarks
@@ -0,0 +1,61 @@
+/* Copyright (c) 2014, The Nuria Project
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *    1. The origin of this software must not be misrepresented; you must not
+ *       claim that you wrote the original software. If you use this software
+ *       in a product, an acknowledgment in the product documentation would be
+ *       appreciated but is not required.
+ *    2. Altered source versions must be plainly marked as such, and must not be
+ *       misrepresented as being the original software.
+ *    3. This notice may not be removed or altered from any source
+ *       distribution.
+ */
+
+
+#include "allocationcounter.hpp"
+#include <atomic>
+
+#ifdef __GLIBC__
+#include <stddef.h>
+
+// Counts calls into malloc() and friends by interposing them. This catches
+// allocations done by Qt containers too, which bypass operator new.
+static std::atomic< qint64 > g_allocations (0);
+
+extern "C" {
+void *__libc_malloc (size_t size);
+void *__libc_calloc (size_t count, size_t size);
+void *__libc_realloc (void *ptr, size_t size);
+
+void *malloc (size_t size) {
+	g_allocations.fetch_add (1, std::memory_order_relaxed);
+	return __libc_malloc (size);
+}
+
+void *calloc (size_t count, size_t size) {
+	g_allocations.fetch_add (1, std::memory_order_relaxed);
+	return __libc_calloc (count, size);
+}
+
+void *realloc (void *ptr, size_t size) {
+	g_allocations.fetch_add (1, std::memory_order_relaxed);
+	return __libc_realloc (ptr, size);
+}
+
+}
+
+qint64 allocationCount () {
+	return g_allocations.load (std::memory_order_relaxed);
+}
+
+#else
+
+qint64 allocationCount () {
+	return -1;
+}
+
+#endif
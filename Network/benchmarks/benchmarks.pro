@@ -0,0 +1,22 @@
+CONFIG   += console c++11 nuria
+QT       += testlib network
+QT       -= gui
+NURIA    += core network
+
+TARGET    = tst_benchmarks
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+INCLUDEPATH = ..
+
+SOURCES += tst_benchmarks.cpp \
+    allocationcounter.cpp \
+    ../httpmemorytransport.cpp \
+    ../httpringtransport.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
+
+HEADERS += \
+    ../httpmemorytransport.hpp \
+    ../httpringtransport.hpp \
+    allocationcounter.hpp \
+    benchnode.hpp
@@ -0,0 +1,111 @@
+/* Copyright (c) 2014, The Nuria Project
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *    1. The origin of this software must not be misrepresented; you must not
+ *       claim that you wrote the original software. If you use this software
+ *       in a product, an acknowledgment in the product documentation would be
+ *       appreciated but is not required.
+ *    2. Altered source versions must be plainly marked as such, and must not be
+ *       misrepresented as being the original software.
+ *    3. This notice may not be removed or altered from any source
+ *       distribution.
+ */
+
+
+#ifndef BENCHNODE_HPP
+#define BENCHNODE_HPP
+
+#include <nuria/restfulhttpnode.hpp>
+#include <nuria/httpclient.hpp>
+#include <nuria/httpnode.hpp>
+#include <QBuffer>
+#include <QFile>
+
+// Root node serving the static resources.
+class BenchNode : public Nuria::HttpNode {
+	Q_OBJECT
+public:
+	QString fileName;
+	
+	explicit BenchNode (QObject *parent = 0)
+		: Nuria::HttpNode (parent)
+	{ }
+	
+	static void echo (Nuria::HttpClient *client)
+	{ client->write (client->readAll ()); }
+	
+	bool invokePath (const QString &path, const QStringList &parts,
+			 int index, Nuria::HttpClient *client) {
+		if (client->verb () == Nuria::HttpClient::POST && path == "/echo") {
+			Nuria::SlotInfo info (&echo);
+			client->setSlotInfo (info);
+			
+		} else if (path == "/buffer") {
+			QBuffer *buffer = new QBuffer;
+			buffer->setData ("0123456789");
+			buffer->open (QIODevice::ReadOnly);
+			client->pipeToClient (buffer);
+			
+		} else if (path == "/file") {
+			QFile *file = new QFile (this->fileName);
+			file->open (QIODevice::ReadOnly);
+			client->pipeToClient (file);
+			
+		} else {
+			return Nuria::HttpNode::invokePath (path, parts, index, client);
+		}
+		
+		return true;
+	}
+	
+};
+
+// Leaf of a tenant subtree. Answers everything below itself.
+class TenantNode : public Nuria::HttpNode {
+	Q_OBJECT
+public:
+	
+	explicit TenantNode (const QString &name)
+		: Nuria::HttpNode (name, nullptr)
+	{ }
+	
+	bool invokePath (const QString &, const QStringList &, int, Nuria::HttpClient *client) {
+		client->write ("tenant");
+		return true;
+	}
+	
+};
+
+// Structure returned by the RESTful handler.
+struct NURIA_INTROSPECT BenchStruct {
+	QString name;
+	int id;
+	bool active;
+};
+
+// Mounted at "/api".
+class NURIA_INTROSPECT BenchRestfulNode : public Nuria::RestfulHttpNode {
+	Q_OBJECT
+public:
+	
+	explicit BenchRestfulNode ()
+		: Nuria::RestfulHttpNode ("api", nullptr)
+	{ }
+	
+	NURIA_RESTFUL("json/{id}")
+	NURIA_RESTFUL_VERBS(Nuria::HttpClient::GET)
+	BenchStruct getJson (int id) {
+		BenchStruct result;
+		result.name = QStringLiteral("Nuria");
+		result.id = id;
+		result.active = true;
+		return result;
+	}
+	
+};
+
+#endif // BENCHNODE_HPP
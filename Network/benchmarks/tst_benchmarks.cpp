@@ -0,0 +1,469 @@
+/* Copyright (c) 2014, The Nuria Project
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *    1. The origin of this software must not be misrepresented; you must not
+ *       claim that you wrote the original software. If you use this software
+ *       in a product, an acknowledgment in the product documentation would be
+ *       appreciated but is not required.
+ *    2. Altered source versions must be plainly marked as such, and must not be
+ *       misrepresented as being the original software.
+ *    3. This notice may not be removed or altered from any source
+ *       distribution.
+ */
+
+#include <nuria/httpclient.hpp>
+
+#include <QtTest/QtTest>
+#include <QTcpSocket>
+#include <QObject>
+#include <algorithm>
+
+#include <httpmemorytransport.hpp>
+#include <httpringtransport.hpp>
+#include <nuria/httpserver.hpp>
+#include <nuria/httpwriter.hpp>
+#include <nuria/httpnode.hpp>
+#include "allocationcounter.hpp"
+#include "benchnode.hpp"
+
+using namespace Nuria;
+
+enum { LoopbackPort = 30080, TenantCount = 5000, ControlCount = 4 };
+
+static int requestCount (int fallback) {
+	int count = qgetenv ("NURIA_BENCHMARK_REQUESTS").toInt ();
+	return (count > 0) ? count : fallback;
+}
+
+// Result of a benchmark run.
+struct Measurement {
+	QVector< qint64 > latencies; // In nanoseconds
+	QVector< qint64 > firstByte; // Connect to first response byte, if known
+	qint64 elapsed = 0; // Wall time of the whole run in nanoseconds
+	qint64 allocations = -1;
+	
+	static double percentile (const QVector< qint64 > &values, double p) {
+		int idx = qMin (int (values.size () * p), values.size () - 1);
+		return values.at (idx) / 1000.0;
+	}
+	
+	void report (const char *name) {
+		if (this->latencies.isEmpty ()) {
+			return;
+		}
+		
+		std::sort (this->latencies.begin (), this->latencies.end ());
+		std::sort (this->firstByte.begin (), this->firstByte.end ());
+		int requests = this->latencies.size ();
+		double perSecond = requests * 1000000000.0 / qMax (this->elapsed, qint64 (1));
+		
+		// QtTest has no requests per second metric, FramesPerSecond is the
+		// closest rate it knows. This makes the figure show up in the
+		// -csv and -xml outputs, like QBENCHMARK results do.
+		QTest::setBenchmarkResult (perSecond, QTest::FramesPerSecond);
+		
+		QByteArray allocs = (this->allocations < 0) ? QByteArray ("n/a")
+				    : QByteArray::number (double (this->allocations) / requests, 'f', 1);
+		
+		qDebug("%s: %i requests, %.0f req/s, p50 %.1f us, p99 %.1f us, p999 %.1f us, %s allocs/req",
+		       name, requests, perSecond, percentile (this->latencies, 0.5),
+		       percentile (this->latencies, 0.99), percentile (this->latencies, 0.999),
+		       allocs.constData ());
+		
+		if (!this->firstByte.isEmpty ()) {
+			qDebug("%s: first byte p50 %.1f us, p99 %.1f us, p999 %.1f us", name,
+			       percentile (this->firstByte, 0.5), percentile (this->firstByte, 0.99),
+			       percentile (this->firstByte, 0.999));
+		}
+		
+	}
+	
+};
+
+// Runs \a request \a requests times, recording the latency of each call.
+// Returns \c false as soon as a request failed.
+template< typename Func >
+static bool measure (Measurement &result, int requests, Func request) {
+	result.latencies.reserve (requests);
+	qint64 allocationsBegin = allocationCount ();
+	QElapsedTimer total;
+	QElapsedTimer timer;
+	total.start ();
+	
+	for (int i = 0; i < requests; i++) {
+		timer.start ();
+		bool success = request ();
+		result.latencies.append (timer.nsecsElapsed ());
+		
+		if (!success) {
+			return false;
+		}
+		
+	}
+	
+	result.elapsed = total.nsecsElapsed ();
+	if (allocationsBegin >= 0) {
+		result.allocations = allocationCount () - allocationsBegin;
+	}
+	
+	return true;
+}
+
+// In-process load generator. Keeps \a connections connections busy until
+// \a requests requests have been answered.
+class LoadGenerator : public QObject {
+	Q_OBJECT
+public:
+	
+	LoadGenerator (const QByteArray &request, quint16 port, int connections, int requests)
+		: m_request (request), m_port (port), m_connections (connections),
+		  m_remaining (requests)
+	{ }
+	
+	Measurement run (int timeout) {
+		this->m_result.latencies.reserve (this->m_remaining);
+		this->m_result.firstByte.reserve (this->m_remaining);
+		qint64 allocationsBegin = allocationCount ();
+		this->m_timer.start ();
+		
+		for (int i = 0; i < this->m_connections.size () && this->m_remaining > 0; i++) {
+			createConnection (i);
+			startRequest (i);
+		}
+		
+		QTimer::singleShot (timeout, &this->m_loop, SLOT(quit()));
+		this->m_loop.exec ();
+		
+		this->m_result.elapsed = this->m_timer.nsecsElapsed ();
+		if (allocationsBegin >= 0) {
+			this->m_result.allocations = allocationCount () - allocationsBegin;
+		}
+		
+		if (this->m_pending > 0) {
+			this->m_failed = true;
+		}
+		
+		return this->m_result;
+	}
+	
+	bool failed () const
+	{ return this->m_failed; }
+	
+private:
+	
+	struct Connection {
+		QTcpSocket *socket = nullptr;
+		QByteArray response;
+		qint64 start = 0;
+	};
+	
+	void createConnection (int idx) {
+		QTcpSocket *socket = new QTcpSocket (this);
+		this->m_connections[idx].socket = socket;
+		
+		connect (socket, &QTcpSocket::connected, [this, socket]() {
+			socket->write (this->m_request);
+		});
+		
+		connect (socket, &QTcpSocket::readyRead, [this, idx, socket]() {
+			Connection &conn = this->m_connections[idx];
+			if (conn.response.isEmpty ()) {
+				this->m_result.firstByte.append (this->m_timer.nsecsElapsed () - conn.start);
+			}
+			
+			conn.response.append (socket->readAll ());
+		});
+		
+		connect (socket, &QTcpSocket::disconnected, this, [this, idx]() {
+			finishRequest (idx);
+		}, Qt::QueuedConnection);
+		
+		connect (socket, static_cast< void (QTcpSocket::*)(QAbstractSocket::SocketError) > (&QTcpSocket::error),
+			 [this](QAbstractSocket::SocketError error) {
+			if (error != QAbstractSocket::RemoteHostClosedError) {
+				this->m_failed = true;
+				this->m_loop.quit ();
+			}
+		});
+		
+	}
+	
+	void startRequest (int idx) {
+		Connection &conn = this->m_connections[idx];
+		this->m_remaining--;
+		this->m_pending++;
+		
+		conn.response.clear ();
+		conn.start = this->m_timer.nsecsElapsed ();
+		conn.socket->connectToHost (QHostAddress::LocalHost, this->m_port);
+	}
+	
+	void finishRequest (int idx) {
+		Connection &conn = this->m_connections[idx];
+		this->m_result.latencies.append (this->m_timer.nsecsElapsed () - conn.start);
+		this->m_pending--;
+		
+		if (!conn.response.startsWith ("HTTP/1.0 200")) {
+			this->m_failed = true;
+		}
+		
+		if (this->m_remaining > 0) {
+			startRequest (idx);
+		} else if (this->m_pending == 0) {
+			this->m_loop.quit ();
+		}
+		
+	}
+	
+	QByteArray m_request;
+	quint16 m_port;
+	QVector< Connection > m_connections;
+	int m_remaining;
+	int m_pending = 0;
+	bool m_failed = false;
+	
+	QElapsedTimer m_timer;
+	QEventLoop m_loop;
+	Measurement m_result;
+	
+};
+
+// 
+class HttpBenchmark : public QObject {
+	Q_OBJECT
+private slots:
+	
+	void initTestCase ();
+	
+	void memoryTransport_data ();
+	void memoryTransport ();
+	
+	void ringTransport_data ();
+	void ringTransport ();
+	
+	void loopback_data ();
+	void loopback ();
+	
+	void writeSessionCookie ();
+	
+private:
+	
+	bool performRequest (const QByteArray &request) {
+		QPointer< HttpMemoryTransport > transport = new HttpMemoryTransport;
+		QPointer< HttpClient > client = new HttpClient (transport, server);
+		transport->setIncoming (request);
+		QCoreApplication::processEvents ();
+		
+		bool success = transport->outData ().startsWith ("HTTP/1.0 200");
+		delete client.data ();
+		delete transport.data ();
+		return success;
+	}
+	
+	bool performRingRequest (const QByteArray &request, int fragmentSize) {
+		HttpRingTransport *transport;
+		HttpRingTransport *peer;
+		HttpRingTransport::createPair (transport, peer);
+		transport->setReadFragmentSize (fragmentSize);
+		
+		QPointer< HttpRingTransport > guard (transport);
+		QPointer< HttpClient > client = new HttpClient (transport, server);
+		QEventLoop loop;
+		QTimer timeout;
+		timeout.setSingleShot (true);
+		connect (&timeout, SIGNAL(timeout()), &loop, SLOT(quit()));
+		connect (peer, SIGNAL(readChannelFinished()), &loop, SLOT(quit()));
+		
+		peer->write (request);
+		timeout.start (1000);
+		loop.exec ();
+		
+		// Running into the timeout counts as failure.
+		bool success = timeout.isActive () && peer->readAll ().startsWith ("HTTP/1.0 200");
+		delete client.data ();
+		delete guard.data ();
+		delete peer;
+		return success;
+	}
+	
+	HttpServer *server = new HttpServer (this);
+	BenchNode *node = new BenchNode (this);
+	BenchRestfulNode *restfulNode = new BenchRestfulNode;
+	QTemporaryFile file;
+	bool listening = false;
+	
+};
+
+void HttpBenchmark::initTestCase () {
+	QVERIFY(this->file.open ());
+	this->file.write (QByteArray (4096, 'x'));
+	this->file.close ();
+	
+	this->node->fileName = this->file.fileName ();
+	this->server->setRoot (this->node);
+	this->node->addNode (this->restfulNode);
+	
+	// Lots of siblings below a single node, to measure child lookup. The
+	// control node has only a few, with a name of the same length.
+	HttpNode *tenants = new HttpNode ("tenants", nullptr);
+	HttpNode *control = new HttpNode ("control", nullptr);
+	for (int i = 0; i < TenantCount; i++) {
+		tenants->addNode (new TenantNode (QStringLiteral("t%1").arg (i)));
+	}
+	
+	for (int i = 0; i < ControlCount; i++) {
+		control->addNode (new TenantNode (QStringLiteral("t%1").arg (i)));
+	}
+	
+	this->node->addNode (tenants);
+	this->node->addNode (control);
+	this->listening = this->server->listen (QHostAddress::LocalHost, LoopbackPort);
+}
+
+// Roughly 4KiB worth of percent-encoded tracking cookies.
+static QByteArray trackingCookies () {
+	QByteArray cookies;
+	for (int i = 0; i < 64; i++) {
+		if (i > 0) {
+			cookies.append ("; ");
+		}
+		
+		cookies.append ("_track" + QByteArray::number (i) + "=");
+		cookies.append ("%7B%22id%22%3A%22" + QByteArray (32, char ('a' + i % 26)) + "%22%7D");
+	}
+	
+	return cookies;
+}
+
+static void addRequestRows () {
+	QTest::addColumn< QByteArray > ("request");
+	
+	QTest::newRow ("buffer") << QByteArray ("GET /buffer HTTP/1.0\r\n\r\n");
+	QTest::newRow ("file") << QByteArray ("GET /file HTTP/1.0\r\n\r\n");
+	QTest::newRow ("json") << QByteArray ("GET /api/json/42 HTTP/1.0\r\n\r\n");
+	QTest::newRow ("echo") << QByteArray ("POST /echo HTTP/1.0\r\n"
+					      "Content-Length: 10\r\n\r\n0123456789");
+	
+	// The handlers never look at the cookies. The padding rows send the
+	// same bytes under a header name of the same length the server doesn't
+	// know, so the difference is the cost of the cookie handling alone.
+	QByteArray cookies = trackingCookies ();
+	QTest::newRow ("buffer with cookies") << "GET /buffer HTTP/1.0\r\nCookie: " + cookies + "\r\n\r\n";
+	QTest::newRow ("buffer with padding") << "GET /buffer HTTP/1.0\r\nX-Fill: " + cookies + "\r\n\r\n";
+	QTest::newRow ("json with cookies") << "GET /api/json/42 HTTP/1.0\r\nCookie: " + cookies + "\r\n\r\n";
+	QTest::newRow ("json with padding") << "GET /api/json/42 HTTP/1.0\r\nX-Fill: " + cookies + "\r\n\r\n";
+	
+	// Same request, differing only in the amount of siblings of "t2".
+	QByteArray lastTenant = QByteArray::number (TenantCount - 1);
+	QTest::newRow ("tenant, 4 siblings") << QByteArray ("GET /control/t2/index HTTP/1.0\r\n\r\n");
+	QTest::newRow ("tenant, 5000 siblings") << QByteArray ("GET /tenants/t2/index HTTP/1.0\r\n\r\n");
+	QTest::newRow ("last tenant, 5000 siblings") << "GET /tenants/t" + lastTenant + "/index HTTP/1.0\r\n\r\n";
+}
+
+void HttpBenchmark::memoryTransport_data () {
+	addRequestRows ();
+}
+
+void HttpBenchmark::memoryTransport () {
+	QFETCH(QByteArray, request);
+	int requests = requestCount (10000);
+	
+	// Warm up
+	QVERIFY(performRequest (request));
+	
+	Measurement result;
+	bool success = measure (result, requests, [this, &request]() {
+		return performRequest (request);
+	});
+	
+	QVERIFY(success);
+	
+	result.report (QTest::currentDataTag ());
+}
+
+void HttpBenchmark::ringTransport_data () {
+	QTest::addColumn< QByteArray > ("request");
+	QTest::addColumn< int > ("fragmentSize");
+	
+	QByteArray buffer = "GET /buffer HTTP/1.0\r\n\r\n";
+	QByteArray json = "GET /api/json/42 HTTP/1.0\r\n\r\n";
+	QByteArray echo = "POST /echo HTTP/1.0\r\nContent-Length: 10\r\n\r\n0123456789";
+	
+	QTest::newRow ("buffer") << buffer << 0;
+	QTest::newRow ("buffer, 8 byte reads") << buffer << 8;
+	QTest::newRow ("json") << json << 0;
+	QTest::newRow ("json, 8 byte reads") << json << 8;
+	QTest::newRow ("echo") << echo << 0;
+	QTest::newRow ("echo, 8 byte reads") << echo << 8;
+}
+
+void HttpBenchmark::ringTransport () {
+	QFETCH(QByteArray, request);
+	QFETCH(int, fragmentSize);
+	int requests = requestCount (10000);
+	
+	// Warm up
+	QVERIFY(performRingRequest (request, fragmentSize));
+	
+	Measurement result;
+	bool success = measure (result, requests, [this, &request, fragmentSize]() {
+		return performRingRequest (request, fragmentSize);
+	});
+	
+	QVERIFY(success);
+	
+	result.report (QTest::currentDataTag ());
+}
+
+void HttpBenchmark::loopback_data () {
+	QTest::addColumn< QByteArray > ("request");
+	QTest::addColumn< int > ("connections");
+	
+	QByteArray buffer = "GET /buffer HTTP/1.0\r\n\r\n";
+	QTest::newRow ("buffer, 1 connection") << buffer << 1;
+	QTest::newRow ("buffer, 16 connections") << buffer << 16;
+	QTest::newRow ("buffer, 256 connections") << buffer << 256;
+	QTest::newRow ("file, 16 connections") << QByteArray ("GET /file HTTP/1.0\r\n\r\n") << 16;
+	QTest::newRow ("json, 16 connections") << QByteArray ("GET /api/json/42 HTTP/1.0\r\n\r\n") << 16;
+	QTest::newRow ("echo, 16 connections") << QByteArray ("POST /echo HTTP/1.0\r\n"
+							      "Content-Length: 10\r\n\r\n0123456789") << 16;
+}
+
+void HttpBenchmark::loopback () {
+	QFETCH(QByteArray, request);
+	QFETCH(int, connections);
+	
+	if (!this->listening) {
+		QSKIP("Failed to listen on the loopback port");
+	}
+	
+	LoadGenerator generator (request, LoopbackPort, connections, requestCount (2000));
+	Measurement result = generator.run (60000);
+	
+	QVERIFY(!generator.failed ());
+	result.report (QTest::currentDataTag ());
+}
+
+void HttpBenchmark::writeSessionCookie () {
+	HttpWriter writer;
+	
+	// Only the value and expiry differ between responses.
+	QNetworkCookie cookie ("session", "0123456789abcdef0123456789abcdef");
+	cookie.setExpirationDate (QDateTime::currentDateTime ().addSecs (3600));
+	cookie.setDomain ("nuriaproject.org");
+	cookie.setPath ("/");
+	cookie.setSecure (true);
+	cookie.setHttpOnly (true);
+	
+	QBENCHMARK {
+		writer.writeSetCookieValue (cookie);
+	}
+	
+}
+
+QTEST_MAIN(HttpBenchmark)
+#include "tst_benchmarks.moc"
@@ -15,3 +15,8 @@ DEFINES += SRCDIR=\\\"$$PWD/\\\"
 
 HEADERS += \
     ../httpmemorytransport.hpp
+
+unix {
+    SOURCES += ../httpsocketpairtransport.cpp
+    HEADERS += ../httpsocketpairtransport.hpp
+}
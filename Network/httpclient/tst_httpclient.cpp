@@ -17,6 +17,10 @@
 #include <QObject>
 
 #include <httpmemorytransport.hpp>
+#ifdef Q_OS_UNIX
+#include <httpsocketpairtransport.hpp>
+#include <QLocalServer>
+#endif
 #include <nuria/httpserver.hpp>
 #include <nuria/httpwriter.hpp>
 #include <nuria/httpnode.hpp>
@@ -107,6 +111,9 @@ private slots:
 	void pipeToClientProcess ();
 	void pipeFromClientBuffer ();
 	void pipeFromClientProcess ();
+	void getHttp11FragmentedOverSocketPair ();
+	void socketPairPeerCloseIsForwarded ();
+	void getHttp11OverLocalSocket ();
 	
 private:
 	
@@ -368,5 +375,94 @@ void HttpClientTest::pipeFromClientProcess () {
 	QVERIFY(!transport->isOpen ());
 }
 
+void HttpClientTest::getHttp11FragmentedOverSocketPair () {
+#ifndef Q_OS_UNIX
+	QSKIP("socketpair() is only available on unix systems");
+#else
+	QByteArray input = "GET /fragmented HTTP/1.1\r\n"
+			   "Host: example.com\r\n"
+			   "\r\n";
+	
+	QByteArray expected = "HTTP/1.1 200 OK\r\nConnection: Close\r\nDate: %%\r\n\r\n"
+			      "/fragmented";
+	insertDateTime (expected);
+	
+	HttpSocketPairTransport *transport = new HttpSocketPairTransport;
+	QScopedPointer< QLocalSocket > peer (transport->peer);
+	QVERIFY(transport->isValid ());
+	
+	QSignalSpy readyReadSpy (transport, SIGNAL(readyRead()));
+	QTest::ignoreMessage (QtDebugMsg, "/fragmented");
+	new HttpClient (transport, server);
+	transport->sendIncoming (input, 3);
+	
+	// Make sure the request didn't arrive in one piece.
+	QVERIFY(readyReadSpy.count () > 1);
+	
+	if (peer->state () != QLocalSocket::UnconnectedState) {
+		runEventLoopUntil (peer.data (), SIGNAL(disconnected()));
+	}
+	
+	QCOMPARE(peer->readAll (), expected);
+#endif
+}
+
+void HttpClientTest::socketPairPeerCloseIsForwarded () {
+#ifndef Q_OS_UNIX
+	QSKIP("socketpair() is only available on unix systems");
+#else
+	HttpSocketPairTransport transport;
+	QScopedPointer< QLocalSocket > peer (transport.peer);
+	QSignalSpy finishedSpy (&transport, SIGNAL(readChannelFinished()));
+	
+	peer->disconnectFromServer ();
+	QVERIFY(finishedSpy.count () == 1 || finishedSpy.wait (1000));
+	QCOMPARE(finishedSpy.count (), 1);
+#endif
+}
+
+void HttpClientTest::getHttp11OverLocalSocket () {
+#ifndef Q_OS_UNIX
+	QSKIP("The transport is only available on unix systems");
+#else
+	QByteArray input = "GET /local HTTP/1.1\r\n"
+			   "Host: example.com\r\n"
+			   "\r\n";
+	
+	QByteArray expected = "HTTP/1.1 200 OK\r\nConnection: Close\r\nDate: %%\r\n\r\n"
+			      "/local";
+	insertDateTime (expected);
+	
+	// Accept a connection on a AF_UNIX socket and wrap it.
+	QString name = QStringLiteral("tst_httpclient_%1").arg (QCoreApplication::applicationPid ());
+	QLocalServer localServer;
+	QLocalServer::removeServer (name);
+	QVERIFY(localServer.listen (name));
+	
+	QLocalSocket peer;
+	peer.connectToServer (name);
+	QVERIFY(peer.waitForConnected (1000));
+	QVERIFY(localServer.waitForNewConnection (1000));
+	
+	QLocalSocket *accepted = localServer.nextPendingConnection ();
+	QVERIFY(accepted);
+	
+	HttpSocketPairTransport *transport = new HttpSocketPairTransport (accepted);
+	QVERIFY(transport->isValid ());
+	QVERIFY(!transport->peer);
+	
+	QTest::ignoreMessage (QtDebugMsg, "/local");
+	new HttpClient (transport, server);
+	peer.write (input);
+	peer.flush ();
+	
+	if (peer.state () != QLocalSocket::UnconnectedState) {
+		runEventLoopUntil (&peer, SIGNAL(disconnected()));
+	}
+	
+	QCOMPARE(peer.readAll (), expected);
+#endif
+}
+
 QTEST_MAIN(HttpClientTest)
 #include "tst_httpclient.moc"
@@ -0,0 +1,418 @@
+/* Copyright (c) 2014, The Nuria Project
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *    1. The origin of this software must not be misrepresented; you must not
+ *       claim that you wrote the original software. If you use this software
+ *       in a product, an acknowledgment in the product documentation would be
+ *       appreciated but is not required.
+ *    2. Altered source versions must be plainly marked as such, and must not be
+ *       misrepresented as being the original software.
+ *    3. This notice may not be removed or altered from any source
+ *       distribution.
+ */
+
+#include "httpringtransport.hpp"
+
+#include <QMutexLocker>
+#include <QMutex>
+#include <atomic>
+#include <vector>
+#include <new>
+#include <string.h>
+
+namespace {
+
+// Single producer/single consumer byte ring. The read and write positions
+// only ever grow, the buffer index is obtained by masking them.
+class RingBuffer {
+public:
+	
+	void allocate (int capacity) {
+		quint64 size = 64;
+		while (size < quint64 (capacity)) {
+			size <<= 1;
+		}
+		
+		this->m_data.resize (size);
+		this->m_mask = size - 1;
+	}
+	
+	// Producer side
+	qint64 freeSpace () const {
+		quint64 head = this->m_head.load (std::memory_order_relaxed);
+		return qint64 (this->m_data.size () - (head - this->m_tail.load (std::memory_order_acquire)));
+	}
+	
+	qint64 write (const char *data, qint64 len) {
+		quint64 head = this->m_head.load (std::memory_order_relaxed);
+		qint64 count = qMin (len, freeSpace ());
+		copyIn (head, data, count);
+		
+		this->m_head.store (head + count, std::memory_order_release);
+		return count;
+	}
+	
+	// Consumer side
+	qint64 available () const {
+		quint64 tail = this->m_tail.load (std::memory_order_relaxed);
+		return qint64 (this->m_head.load (std::memory_order_acquire) - tail);
+	}
+	
+	qint64 read (char *data, qint64 maxlen) {
+		quint64 tail = this->m_tail.load (std::memory_order_relaxed);
+		qint64 count = qMin (maxlen, available ());
+		copyOut (tail, data, count);
+		
+		this->m_tail.store (tail + count, std::memory_order_release);
+		return count;
+	}
+	
+	qint64 indexOf (char c, qint64 maxlen) const {
+		quint64 tail = this->m_tail.load (std::memory_order_relaxed);
+		qint64 count = qMin (maxlen, available ());
+		
+		for (qint64 i = 0; i < count; i++) {
+			if (this->m_data[(tail + i) & this->m_mask] == c) {
+				return i;
+			}
+			
+		}
+		
+		return -1;
+	}
+	
+private:
+	
+	void copyIn (quint64 pos, const char *data, qint64 count) {
+		quint64 offset = pos & this->m_mask;
+		qint64 first = qMin (count, qint64 (this->m_data.size () - offset));
+		memcpy (this->m_data.data () + offset, data, first);
+		memcpy (this->m_data.data (), data + first, count - first);
+	}
+	
+	void copyOut (quint64 pos, char *data, qint64 count) const {
+		quint64 offset = pos & this->m_mask;
+		qint64 first = qMin (count, qint64 (this->m_data.size () - offset));
+		memcpy (data, this->m_data.data () + offset, first);
+		memcpy (data + first, this->m_data.data (), count - first);
+	}
+	
+	std::vector< char > m_data;
+	quint64 m_mask = 0;
+	
+	// Keep the positions on different cache lines, as they're written by
+	// different threads.
+	alignas(64) std::atomic< quint64 > m_head { 0 }; // Written by the producer
+	alignas(64) std::atomic< quint64 > m_tail { 0 }; // Written by the consumer
+	
+};
+
+}
+
+// rings[i] is written by ends[i] and read by the other end. The data path
+// is lock-free, only waking up the other end takes \a lock. It keeps ends[]
+// from being cleared by a destructor while another thread posts to it.
+struct Nuria::HttpRingChannel {
+	RingBuffer rings[2];
+	QMutex lock;
+	HttpRingTransport *ends[2];
+	std::atomic< bool > notified[2]; // ends[i] has a deliver() queued
+	std::atomic< bool > waiting[2]; // ends[i] waits for room to write
+	std::atomic< bool > closed[2]; // ends[i] was closed
+	
+	explicit HttpRingChannel (int capacity) {
+		for (int i = 0; i < 2; i++) {
+			this->rings[i].allocate (capacity);
+			this->ends[i] = nullptr;
+			this->notified[i].store (false);
+			this->waiting[i].store (false);
+			this->closed[i].store (false);
+		}
+		
+	}
+	
+	// Queues a call to \a method of ends[side], if it still exists.
+	void invoke (int side, const char *method) {
+		QMutexLocker locker (&this->lock);
+		if (this->ends[side]) {
+			QMetaObject::invokeMethod (this->ends[side], method, Qt::QueuedConnection);
+		}
+		
+	}
+	
+	void setEnd (int side, HttpRingTransport *transport) {
+		QMutexLocker locker (&this->lock);
+		this->ends[side] = transport;
+	}
+	
+	// The rings are cache line aligned, which plain new only honours
+	// starting with C++17.
+	static void *operator new (size_t size) {
+		void *ptr = qMallocAligned (size, alignof(HttpRingChannel));
+		if (!ptr) {
+			throw std::bad_alloc ();
+		}
+		
+		return ptr;
+	}
+	
+	static void operator delete (void *ptr) {
+		qFreeAligned (ptr);
+	}
+	
+};
+
+Nuria::HttpRingTransport::HttpRingTransport (const QSharedPointer< HttpRingChannel > &channel, int side)
+	: HttpTransport (nullptr), m_channel (channel), m_side (side)
+{
+	
+	this->m_channel->setEnd (side, this);
+	setOpenMode (ReadWrite);
+	
+}
+
+void Nuria::HttpRingTransport::createPair (HttpRingTransport *&first, HttpRingTransport *&second,
+					   int capacity) {
+	QSharedPointer< HttpRingChannel > channel (new HttpRingChannel (capacity));
+	first = new HttpRingTransport (channel, 0);
+	second = new HttpRingTransport (channel, 1);
+}
+
+Nuria::HttpRingTransport::~HttpRingTransport () {
+	if (!this->m_channel->closed[this->m_side].load ()) {
+		markClosed ();
+	}
+	
+	// Waits for invocations the other end is doing on us right now.
+	this->m_channel->setEnd (this->m_side, nullptr);
+}
+
+void Nuria::HttpRingTransport::setReadFragmentSize (int bytes) {
+	this->m_fragmentSize = qMax (bytes, 0);
+}
+
+int Nuria::HttpRingTransport::readFragmentSize () const {
+	return this->m_fragmentSize;
+}
+
+void Nuria::HttpRingTransport::close () {
+	if (!isOpen ()) {
+		return;
+	}
+	
+	emit aboutToClose ();
+	setOpenMode (NotOpen);
+	
+	// Pending data is still written, the peer is told afterwards.
+	this->m_closing = true;
+	if (this->m_pending.isEmpty ()) {
+		markClosed ();
+	}
+	
+}
+
+bool Nuria::HttpRingTransport::isSequential () const {
+	return true;
+}
+
+qint64 Nuria::HttpRingTransport::bytesAvailable () const {
+	return this->m_visible + QIODevice::bytesAvailable ();
+}
+
+qint64 Nuria::HttpRingTransport::bytesToWrite () const {
+	return this->m_pending.size ();
+}
+
+bool Nuria::HttpRingTransport::canReadLine () const {
+	const RingBuffer &ring = this->m_channel->rings[1 - this->m_side];
+	return (ring.indexOf ('\n', this->m_visible) >= 0 || QIODevice::canReadLine ());
+}
+
+qint64 Nuria::HttpRingTransport::readData (char *data, qint64 maxlen) {
+	RingBuffer &ring = this->m_channel->rings[1 - this->m_side];
+	qint64 count = ring.read (data, qMin (maxlen, this->m_visible));
+	this->m_visible -= count;
+	
+	if (count > 0) {
+		notifyWriter ();
+	}
+	
+	return count;
+}
+
+qint64 Nuria::HttpRingTransport::readLineData (char *data, qint64 maxlen) {
+	const RingBuffer &ring = this->m_channel->rings[1 - this->m_side];
+	qint64 idx = ring.indexOf ('\n', this->m_visible);
+	qint64 count = (idx < 0) ? this->m_visible : idx + 1;
+	return readData (data, qMin (count, maxlen));
+}
+
+qint64 Nuria::HttpRingTransport::writeData (const char *data, qint64 len) {
+	RingBuffer &ring = this->m_channel->rings[this->m_side];
+	qint64 written = 0;
+	
+	if (peerClosed ()) {
+		return -1;
+	}
+	
+	if (this->m_pending.isEmpty ()) {
+		written = ring.write (data, len);
+	}
+	
+	if (written < len) {
+		this->m_pending.append (data + written, len - written);
+		this->m_channel->waiting[this->m_side].store (true);
+		
+		// The reader may have made room before it saw the flag.
+		if (ring.freeSpace () > 0) {
+			queueDrain ();
+		}
+		
+	}
+	
+	if (written > 0) {
+		notifyPeer ();
+		
+		// Report it from the event loop, coalescing multiple writes.
+		if (this->m_unreported == 0) {
+			QMetaObject::invokeMethod (this, "reportWritten", Qt::QueuedConnection);
+		}
+		
+		this->m_unreported += written;
+	}
+	
+	return len;
+}
+
+void Nuria::HttpRingTransport::deliver () {
+	int other = 1 - this->m_side;
+	RingBuffer &ring = this->m_channel->rings[other];
+	this->m_channel->notified[this->m_side].store (false);
+	
+	// Read the flag first, so all data written before closing is seen.
+	bool peerClosed = this->m_channel->closed[other].load (std::memory_order_acquire);
+	qint64 available = ring.available ();
+	qint64 visible = available;
+	
+	if (this->m_fragmentSize > 0) {
+		visible = qMin (available, this->m_visible + this->m_fragmentSize);
+	}
+	
+	bool grown = (visible > this->m_visible);
+	this->m_visible = visible;
+	
+	if (grown) {
+		emit readyRead ();
+	}
+	
+	// Like QAbstractSocket, report the peer closing once everything it sent
+	// is readable, without waiting for it to be read.
+	if (this->m_visible < ring.available ()) {
+		QMetaObject::invokeMethod (this, "deliver", Qt::QueuedConnection);
+	} else if (peerClosed && !this->m_finished) {
+		this->m_finished = true;
+		emit readChannelFinished ();
+	}
+	
+	// Let drain() drop what can't be delivered anymore.
+	if (peerClosed && !this->m_pending.isEmpty ()) {
+		queueDrain ();
+	}
+	
+}
+
+void Nuria::HttpRingTransport::drain () {
+	RingBuffer &ring = this->m_channel->rings[this->m_side];
+	this->m_channel->waiting[this->m_side].store (false);
+	this->m_drainQueued = false;
+	
+	if (peerClosed ()) {
+		if (this->m_closing) {
+			markClosed ();
+		}
+		
+		return;
+	}
+	
+	qint64 written = ring.write (this->m_pending.constData (), this->m_pending.size ());
+	this->m_pending.remove (0, written);
+	
+	if (!this->m_pending.isEmpty ()) {
+		this->m_channel->waiting[this->m_side].store (true);
+		if (ring.freeSpace () > 0) {
+			queueDrain ();
+		}
+		
+	}
+	
+	if (written > 0) {
+		notifyPeer ();
+		emit bytesWritten (written);
+	}
+	
+	if (this->m_closing && this->m_pending.isEmpty ()) {
+		markClosed ();
+	}
+	
+}
+
+void Nuria::HttpRingTransport::notifyPeer () {
+	int other = 1 - this->m_side;
+	if (this->m_channel->notified[other].exchange (true)) {
+		return;
+	}
+	
+	this->m_channel->invoke (other, "deliver");
+}
+
+void Nuria::HttpRingTransport::notifyWriter () {
+	int other = 1 - this->m_side;
+	if (!this->m_channel->waiting[other].exchange (false)) {
+		return;
+	}
+	
+	this->m_channel->invoke (other, "drain");
+}
+
+void Nuria::HttpRingTransport::markClosed () {
+	this->m_closing = false;
+	this->m_channel->closed[this->m_side].store (true, std::memory_order_release);
+	
+	// Wake the peer even if a deliver() is already queued, as that one may
+	// run before the flag is visible.
+	this->m_channel->invoke (1 - this->m_side, "deliver");
+}
+
+void Nuria::HttpRingTransport::reportWritten () {
+	qint64 written = this->m_unreported;
+	this->m_unreported = 0;
+	
+	if (written > 0) {
+		emit bytesWritten (written);
+	}
+	
+}
+
+void Nuria::HttpRingTransport::queueDrain () {
+	if (!this->m_drainQueued) {
+		this->m_drainQueued = true;
+		QMetaObject::invokeMethod (this, "drain", Qt::QueuedConnection);
+	}
+	
+}
+
+bool Nuria::HttpRingTransport::peerClosed () {
+	if (!this->m_channel->closed[1 - this->m_side].load ()) {
+		return false;
+	}
+	
+	// Nobody will read it anymore.
+	this->m_pending.clear ();
+	this->m_channel->waiting[this->m_side].store (false);
+	setErrorString (QStringLiteral("The other end was closed"));
+	return true;
+}
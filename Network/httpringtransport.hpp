@@ -0,0 +1,114 @@
+/* Copyright (c) 2014, The Nuria Project
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *    1. The origin of this software must not be misrepresented; you must not
+ *       claim that you wrote the original software. If you use this software
+ *       in a product, an acknowledgment in the product documentation would be
+ *       appreciated but is not required.
+ *    2. Altered source versions must be plainly marked as such, and must not be
+ *       misrepresented as being the original software.
+ *    3. This notice may not be removed or altered from any source
+ *       distribution.
+ */
+
+#ifndef NURIA_HTTPRINGTRANSPORT_HPP
+#define NURIA_HTTPRINGTRANSPORT_HPP
+
+#include <nuria/httptransport.hpp>
+#include <QSharedPointer>
+
+namespace Nuria {
+
+struct HttpRingChannel;
+
+/**
+ * \brief HttpTransport pair connected through lock-free ring buffers.
+ * 
+ * Both ends are created at once using createPair(). Data written into one
+ * end can be read from the other one, each direction using its own single
+ * producer/single consumer ring buffer. As the ends only notify each other
+ * through queued invocations, they can live in different threads, e.g. to
+ * put a HttpClient into a server thread and drive it from another one.
+ * 
+ * Unlike HttpMemoryTransport, the data arrives asynchronously: Each turn of
+ * the event loop of the reading end makes up to readFragmentSize() new
+ * bytes readable, which can be used to simulate partial reads.
+ * 
+ * Writes which don't fit into the ring buffer are kept in bytesToWrite()
+ * until the reader made room. bytesWritten() is emitted asynchronously for
+ * all written bytes, like QAbstractSocket does. Closing one end makes the
+ * other one emit readChannelFinished() once everything written before is
+ * readable. Writing to an end whose peer was closed fails and drops all
+ * pending data.
+ * 
+ * Either end can be destroyed at any time, from its own thread. The other
+ * end then sees it as closed.
+ */
+class HttpRingTransport : public HttpTransport {
+	Q_OBJECT
+public:
+	enum { DefaultCapacity = 64 * 1024 };
+	
+	/**
+	 * Creates a pair of connected transports and stores them in \a first
+	 * and \a second. Each direction can buffer \a capacity bytes, rounded
+	 * up to the next power of two.
+	 */
+	static void createPair (HttpRingTransport *&first, HttpRingTransport *&second,
+				int capacity = DefaultCapacity);
+	
+	/** Destructor. */
+	~HttpRingTransport ();
+	
+	/**
+	 * Sets the maximum amount of bytes made readable per event loop turn.
+	 * \c 0, the default, makes everything available at once.
+	 */
+	void setReadFragmentSize (int bytes);
+	
+	/** Returns the read fragment size. */
+	int readFragmentSize () const;
+	
+	void close ();
+	bool isSequential () const;
+	qint64 bytesAvailable () const;
+	qint64 bytesToWrite () const;
+	bool canReadLine () const;
+	
+protected:
+	qint64 readData (char *data, qint64 maxlen);
+	qint64 readLineData(char *data, qint64 maxlen);
+	qint64 writeData (const char *data, qint64 len);
+	
+private slots:
+	void deliver ();
+	void drain ();
+	void reportWritten ();
+	
+private:
+	HttpRingTransport (const QSharedPointer< HttpRingChannel > &channel, int side);
+	void notifyPeer ();
+	void notifyWriter ();
+	void markClosed ();
+	void queueDrain ();
+	bool peerClosed ();
+	
+	QSharedPointer< HttpRingChannel > m_channel;
+	int m_side;
+	int m_fragmentSize = 0;
+	qint64 m_visible = 0;
+	bool m_finished = false;
+	bool m_closing = false;
+	bool m_drainQueued = false;
+	qint64 m_unreported = 0;
+	QByteArray m_pending;
+	
+};
+
+}
+
+#endif // NURIA_HTTPRINGTRANSPORT_HPP
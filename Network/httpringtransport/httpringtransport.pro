@@ -0,0 +1,17 @@
+CONFIG   += console c++11 nuria
+QT       += testlib
+QT       -= gui
+NURIA    += core network
+
+TARGET    = tst_httpringtransport
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+INCLUDEPATH = ..
+
+SOURCES += tst_httpringtransport.cpp \
+    ../httpringtransport.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
+
+HEADERS += \
+    ../httpringtransport.hpp
@@ -0,0 +1,236 @@
+/* Copyright (c) 2014, The Nuria Project
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *    1. The origin of this software must not be misrepresented; you must not
+ *       claim that you wrote the original software. If you use this software
+ *       in a product, an acknowledgment in the product documentation would be
+ *       appreciated but is not required.
+ *    2. Altered source versions must be plainly marked as such, and must not be
+ *       misrepresented as being the original software.
+ *    3. This notice may not be removed or altered from any source
+ *       distribution.
+ */
+
+#include <httpringtransport.hpp>
+
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QThread>
+
+using namespace Nuria;
+
+enum { Capacity = 64 };
+
+// Writes data in chunks from within its thread, then closes the transport.
+class RingWriter : public QObject {
+	Q_OBJECT
+public:
+	HttpRingTransport *transport;
+	QByteArray data;
+	
+public slots:
+	void run () {
+		for (int i = 0; i < this->data.size (); i += 1000) {
+			this->transport->write (this->data.mid (i, 1000));
+		}
+		
+		this->transport->close ();
+	}
+	
+};
+
+// 
+class HttpRingTransportTest : public QObject {
+	Q_OBJECT
+private slots:
+	
+	void init ();
+	void cleanup ();
+	
+	void writeAndRead ();
+	void wrapAround ();
+	void readLineAcrossWrapPoint ();
+	void writeMoreThanCapacity ();
+	void closeWithPendingData ();
+	void writeToClosedPeerFails ();
+	void readFragments ();
+	void destroyingAnEndClosesIt ();
+	void crossThread ();
+	
+private:
+	HttpRingTransport *first = nullptr;
+	HttpRingTransport *second = nullptr;
+	
+};
+
+static QByteArray pattern (int length, char offset = 0) {
+	QByteArray data (length, Qt::Uninitialized);
+	for (int i = 0; i < length; i++) {
+		data[i] = char ('a' + (i + offset) % 26);
+	}
+	
+	return data;
+}
+
+// Processes events until \a count bytes were read from \a transport.
+static QByteArray readBytes (HttpRingTransport *transport, int count) {
+	QByteArray result;
+	QElapsedTimer timer;
+	timer.start ();
+	
+	while (result.size () < count && timer.elapsed () < 1000) {
+		QCoreApplication::processEvents ();
+		result.append (transport->read (count - result.size ()));
+	}
+	
+	return result;
+}
+
+void HttpRingTransportTest::init () {
+	HttpRingTransport::createPair (this->first, this->second, Capacity);
+}
+
+void HttpRingTransportTest::cleanup () {
+	delete this->first;
+	delete this->second;
+	this->first = nullptr;
+	this->second = nullptr;
+}
+
+void HttpRingTransportTest::writeAndRead () {
+	QCOMPARE(this->first->write ("0123456789"), qint64 (10));
+	QCOMPARE(this->second->bytesAvailable (), qint64 (0));
+	
+	QCOMPARE(readBytes (this->second, 10), QByteArray ("0123456789"));
+	QCOMPARE(this->first->bytesAvailable (), qint64 (0));
+}
+
+void HttpRingTransportTest::wrapAround () {
+	QByteArray one = pattern (50);
+	QByteArray two = pattern (40, 7);
+	
+	this->first->write (one);
+	QCOMPARE(readBytes (this->second, one.size ()), one);
+	
+	// Positions 50 to 90 wrap around the end of the ring.
+	this->first->write (two);
+	QCOMPARE(this->first->bytesToWrite (), qint64 (0));
+	QCOMPARE(readBytes (this->second, two.size ()), two);
+}
+
+void HttpRingTransportTest::readLineAcrossWrapPoint () {
+	QByteArray fill = pattern (60);
+	this->first->write (fill);
+	QCOMPARE(readBytes (this->second, fill.size ()), fill);
+	
+	this->first->write ("foo\nbar\n");
+	QTRY_VERIFY(this->second->canReadLine ());
+	QCOMPARE(this->second->readLine (), QByteArray ("foo\n"));
+	QCOMPARE(this->second->readLine (), QByteArray ("bar\n"));
+}
+
+void HttpRingTransportTest::writeMoreThanCapacity () {
+	QSignalSpy bytesWrittenSpy (this->first, SIGNAL(bytesWritten(qint64)));
+	QByteArray data = pattern (200);
+	
+	QCOMPARE(this->first->write (data), qint64 (200));
+	QCOMPARE(this->first->bytesToWrite (), qint64 (200 - Capacity));
+	QCOMPARE(readBytes (this->second, data.size ()), data);
+	QCOMPARE(this->first->bytesToWrite (), qint64 (0));
+	QCoreApplication::processEvents ();
+	
+	// Includes the bytes which went straight into the ring.
+	qint64 written = 0;
+	for (const QList< QVariant > &args : bytesWrittenSpy) {
+		written += args.first ().toLongLong ();
+	}
+	
+	QCOMPARE(written, qint64 (200));
+}
+
+void HttpRingTransportTest::closeWithPendingData () {
+	QSignalSpy finishedSpy (this->second, SIGNAL(readChannelFinished()));
+	QByteArray data = pattern (200);
+	
+	this->first->write (data);
+	this->first->close ();
+	QVERIFY(!this->first->isOpen ());
+	
+	// The close is only seen once the pending data was written.
+	QTRY_COMPARE(this->second->bytesAvailable (), qint64 (Capacity));
+	QCOMPARE(finishedSpy.count (), 0);
+	
+	QCOMPARE(readBytes (this->second, data.size ()), data);
+	QTRY_COMPARE(finishedSpy.count (), 1);
+}
+
+void HttpRingTransportTest::writeToClosedPeerFails () {
+	this->first->write (pattern (200));
+	QCOMPARE(this->first->bytesToWrite (), qint64 (200 - Capacity));
+	
+	delete this->second;
+	this->second = nullptr;
+	
+	QTRY_COMPARE(this->first->bytesToWrite (), qint64 (0));
+	QCOMPARE(this->first->write ("foo"), qint64 (-1));
+	QVERIFY(!this->first->errorString ().isEmpty ());
+}
+
+void HttpRingTransportTest::readFragments () {
+	QList< qint64 > available;
+	connect (this->second, &QIODevice::readyRead, [this, &available]() {
+		available.append (this->second->bytesAvailable ());
+	});
+	
+	this->second->setReadFragmentSize (4);
+	this->first->write ("0123456789");
+	
+	QTRY_COMPARE(this->second->bytesAvailable (), qint64 (10));
+	QCOMPARE(available, QList< qint64 > ({ 4, 8, 10 }));
+	QCOMPARE(this->second->readAll (), QByteArray ("0123456789"));
+}
+
+void HttpRingTransportTest::destroyingAnEndClosesIt () {
+	QSignalSpy finishedSpy (this->second, SIGNAL(readChannelFinished()));
+	
+	delete this->first;
+	this->first = nullptr;
+	
+	QTRY_COMPARE(finishedSpy.count (), 1);
+}
+
+void HttpRingTransportTest::crossThread () {
+	QThread thread;
+	RingWriter writer;
+	writer.transport = this->first;
+	writer.data = pattern (100000);
+	
+	this->first->moveToThread (&thread);
+	writer.moveToThread (&thread);
+	thread.start ();
+	
+	QByteArray received;
+	QSignalSpy finishedSpy (this->second, SIGNAL(readChannelFinished()));
+	connect (this->second, &QIODevice::readyRead, [this, &received]() {
+		received.append (this->second->readAll ());
+	});
+	
+	QMetaObject::invokeMethod (&writer, "run", Qt::QueuedConnection);
+	QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count (), 1, 10000);
+	
+	// Has to be destroyed in its own thread.
+	this->first->deleteLater ();
+	this->first = nullptr;
+	thread.quit ();
+	thread.wait ();
+	
+	QCOMPARE(received.size (), writer.data.size ());
+	QVERIFY(received == writer.data);
+}
+
+QTEST_MAIN(HttpRingTransportTest)
+#include "tst_httpringtransport.moc"
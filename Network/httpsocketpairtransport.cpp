@@ -0,0 +1,119 @@
+/* Copyright (c) 2014, The Nuria Project
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *    1. The origin of this software must not be misrepresented; you must not
+ *       claim that you wrote the original software. If you use this software
+ *       in a product, an acknowledgment in the product documentation would be
+ *       appreciated but is not required.
+ *    2. Altered source versions must be plainly marked as such, and must not be
+ *       misrepresented as being the original software.
+ *    3. This notice may not be removed or altered from any source
+ *       distribution.
+ */
+
+#include "httpsocketpairtransport.hpp"
+
+#include <QCoreApplication>
+#include <sys/socket.h>
+#include <string.h>
+#include <errno.h>
+
+Nuria::HttpSocketPairTransport::HttpSocketPairTransport (QObject *parent)
+	: HttpTransport (parent)
+{
+	
+	this->socket = new QLocalSocket (this);
+	this->peer = new QLocalSocket;
+	
+	int fds[2];
+	if (::socketpair (AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+		qWarning("socketpair() failed: %s", strerror (errno));
+		return;
+	}
+	
+	this->socket->setSocketDescriptor (fds[0]);
+	this->peer->setSocketDescriptor (fds[1]);
+	connectSocket ();
+	
+}
+
+Nuria::HttpSocketPairTransport::HttpSocketPairTransport (QLocalSocket *socket, QObject *parent)
+	: HttpTransport (parent), socket (socket), peer (nullptr)
+{
+	
+	this->socket->setParent (this);
+	connectSocket ();
+	
+}
+
+void Nuria::HttpSocketPairTransport::connectSocket () {
+	connect (this->socket, SIGNAL(readyRead()), SIGNAL(readyRead()));
+	connect (this->socket, SIGNAL(bytesWritten(qint64)), SIGNAL(bytesWritten(qint64)));
+	connect (this->socket, SIGNAL(disconnected()), SLOT(socketDisconnected()));
+	setOpenMode (ReadWrite);
+}
+
+void Nuria::HttpSocketPairTransport::socketDisconnected () {
+	
+	// Only report it if the peer closed the connection, not us.
+	if (isOpen ()) {
+		emit readChannelFinished ();
+	}
+	
+}
+
+void Nuria::HttpSocketPairTransport::sendIncoming (const QByteArray &data, int chunkSize) {
+	if (!this->peer) {
+		return;
+	}
+	
+	if (chunkSize < 1) {
+		chunkSize = data.length ();
+	}
+	
+	for (int i = 0; i < data.length (); i += chunkSize) {
+		this->peer->write (data.mid (i, chunkSize));
+		this->peer->flush ();
+		QCoreApplication::processEvents ();
+	}
+	
+}
+
+void Nuria::HttpSocketPairTransport::close () {
+	emit aboutToClose ();
+	setOpenMode (NotOpen);
+	this->socket->flush ();
+	this->socket->disconnectFromServer ();
+}
+
+bool Nuria::HttpSocketPairTransport::isSequential () const {
+	return true;
+}
+
+qint64 Nuria::HttpSocketPairTransport::bytesAvailable () const {
+	return this->socket->bytesAvailable () + QIODevice::bytesAvailable ();
+}
+
+qint64 Nuria::HttpSocketPairTransport::bytesToWrite () const {
+	return this->socket->bytesToWrite ();
+}
+
+bool Nuria::HttpSocketPairTransport::canReadLine () const {
+	return this->socket->canReadLine () || QIODevice::canReadLine ();
+}
+
+qint64 Nuria::HttpSocketPairTransport::readData (char *data, qint64 maxlen) {
+	return this->socket->read (data, maxlen);
+}
+
+qint64 Nuria::HttpSocketPairTransport::readLineData (char *data, qint64 maxlen) {
+	return this->socket->readLine (data, maxlen);
+}
+
+qint64 Nuria::HttpSocketPairTransport::writeData (const char *data, qint64 len) {
+	return this->socket->write (data, len);
+}
@@ -0,0 +1,92 @@
+/* Copyright (c) 2014, The Nuria Project
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *    1. The origin of this software must not be misrepresented; you must not
+ *       claim that you wrote the original software. If you use this software
+ *       in a product, an acknowledgment in the product documentation would be
+ *       appreciated but is not required.
+ *    2. Altered source versions must be plainly marked as such, and must not be
+ *       misrepresented as being the original software.
+ *    3. This notice may not be removed or altered from any source
+ *       distribution.
+ */
+
+#ifndef NURIA_HTTPSOCKETPAIRTRANSPORT_HPP
+#define NURIA_HTTPSOCKETPAIRTRANSPORT_HPP
+
+#include <nuria/httptransport.hpp>
+#include <QLocalSocket>
+
+namespace Nuria {
+
+/**
+ * \brief HttpTransport on top of a AF_UNIX socketpair for testing purposes.
+ * 
+ * Unlike HttpMemoryTransport, data written into \a peer goes through the
+ * kernel and arrives at the HttpClient whenever the event loop picks it up,
+ * which makes partial reads behave like they would on a real connection.
+ * 
+ * The transport can also wrap an already connected AF_UNIX stream socket,
+ * e.g. one accepted by a QLocalServer. \a peer is \c nullptr then.
+ * 
+ * When the peer closes the connection, readChannelFinished() is emitted.
+ * 
+ * \note The peer socket is not owned by the transport, so it outlives the
+ * HttpClient closing the connection. Delete it when done.
+ */
+class HttpSocketPairTransport : public HttpTransport {
+	Q_OBJECT
+public:
+	QLocalSocket *socket; // Transport <-> HttpClient
+	QLocalSocket *peer; // Test <-> Transport
+	
+	/** Constructor. Creates a new socketpair. */
+	explicit HttpSocketPairTransport (QObject *parent = 0);
+	
+	/**
+	 * Constructor. Wraps the connected \a socket, taking ownership of
+	 * it. There is no peer in this case.
+	 */
+	explicit HttpSocketPairTransport (QLocalSocket *socket, QObject *parent = 0);
+	
+	/**
+	 * Returns \c true if the transport has a usable socket. This is not
+	 * the case if creating the socketpair failed.
+	 */
+	bool isValid () const
+	{ return this->socket->isValid (); }
+	
+	/**
+	 * Writes \a data into the peer, \a chunkSize bytes at a time. Events
+	 * are processed after each chunk, so the HttpClient sees each of them
+	 * as separate read. A \a chunkSize of \c 0 writes everything at once.
+	 * Does nothing if there is no peer.
+	 */
+	void sendIncoming (const QByteArray &data, int chunkSize = 0);
+	
+	void close ();
+	bool isSequential () const;
+	qint64 bytesAvailable () const;
+	qint64 bytesToWrite () const;
+	bool canReadLine () const;
+	
+protected:
+	qint64 readData (char *data, qint64 maxlen);
+	qint64 readLineData(char *data, qint64 maxlen);
+	qint64 writeData (const char *data, qint64 len);
+	
+private slots:
+	void socketDisconnected ();
+	
+private:
+	void connectSocket ();
+	
+};
+
+}
+
+#endif // NURIA_HTTPSOCKETPAIRTRANSPORT_HPP
@@ -3,11 +3,13 @@ KnownModules=(Core Network)
 Modules=()
 Verbose=0
 Rebuild=0
+Benchmarks=0
 
 if [ "$1" == '-h' ] || [ "$1" == '-help' ] || [ "$1" == '--help' ]; then
-  echo "Usage: runAllTests.sh [-r|--rebuild] [-v|--verbose] [Modules]"
+  echo "Usage: runAllTests.sh [-r|--rebuild] [-v|--verbose] [-b|--benchmarks] [Modules]"
   echo "-r --rebuild      Rebuilds all tests in [Modules]"
   echo "-v --verbose      Outputs everything"
+  echo "-b --benchmarks   Also builds and runs the benchmarks"
   echo 
   echo "By default the script will run all tests in [Modules]"
   echo "If the tests are not already built, or if --rebuild was passed, those will be compiled."
@@ -20,6 +22,8 @@ while (( $# > 0 )); do
     Verbose=1
   elif [ $1 == '-r' ] || [ $1 == '--rebuild' ]; then
     Rebuild=1
+  elif [ $1 == '-b' ] || [ $1 == '--benchmarks' ]; then
+    Benchmarks=1
   else
     Modules+=("$1")
   fi
@@ -52,6 +56,10 @@ function buildTest() {
   cd ../..
 }
 
+function isSkipped() {
+  [ $Benchmarks == 0 ] && [ "$(basename "$1")" == 'benchmarks' ]
+}
+
 function runTest() {
   Name="$1"
   Binary=./tst_$(echo $Name|sed 's!.*/!!')
@@ -69,6 +77,7 @@ if [ $Rebuild == 1 ]; then
   for i in ${Modules[@]}; do
     for j in $i/*; do
       [ ! -d "$j" ] && continue
+      isSkipped "$j" && continue
       cd $j
       make clean
       rm $(find . -name 'tst_*' -executable)
@@ -81,6 +90,7 @@ fi
 for i in ${Modules[@]}; do
   for j in $i/*; do
     [ ! -d "$j" ] && continue
+    isSkipped "$j" && continue
     buildTest $j
     (cd $j; runTest $j)
   done